@@ -11,18 +11,37 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <errno.h>
 #include <limits.h>
+#ifdef _arch_dreamcast
 #include <kos.h>
+#endif
 
 #ifndef UINT64_MAX
 #define UINT64_MAX 0xFFFFFFFFFFFFFFFFULL
 #endif
 
+#ifdef _arch_dreamcast
+extern uint8 romdisk_boot[];
 KOS_INIT_FLAGS(INIT_DEFAULT);
+KOS_INIT_ROMDISK(romdisk_boot);
+#endif
+
+#define NUM_TESTS   17
+#define MAX_PIXELS  0x80000
+#define MAX_SIZES   8
+// Widest loop step: 32-bit unroll 16 and 64-bit unroll 8 both eat 32 pixels
+#define SIZE_ALIGN  32
+// gettimeofday() only ticks in microseconds, so small buffers are converted
+// several times per timed sample until a sample lasts at least this long
+#define MIN_SAMPLE_US  2000
+#define MAX_BATCH      (1u << 20)
 
 // Align buffers to cache line boundary (32 bytes on SH4)
-static uint16_t buffer_bgr555[0x80000] __attribute__((aligned(32)));
-static uint16_t buffer_rgb565[0x80000] __attribute__((aligned(32)));
+static uint16_t buffer_bgr555[MAX_PIXELS] __attribute__((aligned(32)));
+static uint16_t buffer_rgb565[MAX_PIXELS] __attribute__((aligned(32)));
 
 // Test names for reporting
 static const char* test_names[] = {
@@ -407,19 +426,20 @@ static void convert_buffer(uint16_t * restrict bgr555,
 }
 
 // Warm up cache and test correctness
-static void warmup_and_verify(void)
+static void warmup_and_verify(int quiet)
 {
     unsigned int i;
     
     // Initialize with test pattern
-    for (i = 0; i < 0x80000; i++) {
+    for (i = 0; i < MAX_PIXELS; i++) {
         buffer_bgr555[i] = i & 0x7fff;
     }
     
     // Run conversion and verify first few results
     convert_buffer(buffer_bgr555, buffer_rgb565, 128, 0);
     
-    printf("Verifying conversion correctness... ");
+    if (!quiet)
+        printf("Verifying conversion correctness... ");
     int all_correct = 1;
     for (i = 0; i < 16; i++) {
         uint16_t bgr = buffer_bgr555[i];
@@ -427,65 +447,405 @@ static void warmup_and_verify(void)
         uint16_t expected = bgr555_to_rgb565(bgr);
         if (rgb != expected) {
             all_correct = 0;
-            printf("\n  ERROR at index %d: BGR555: 0x%04x -> RGB565: 0x%04x (expected: 0x%04x)", 
-                   i, bgr, rgb, expected);
+            fprintf(quiet ? stderr : stdout,
+                    "\n  ERROR at index %d: BGR555: 0x%04x -> RGB565: 0x%04x (expected: 0x%04x)",
+                    i, bgr, rgb, expected);
         }
     }
     if (all_correct) {
-        printf("[OK] All conversions correct!\n\n");
+        if (!quiet)
+            printf("[OK] All conversions correct!\n\n");
     } else {
-        printf("\n  [ERROR] Conversion errors detected!\n\n");
+        fprintf(quiet ? stderr : stdout, "\n  [ERROR] Conversion errors detected!\n\n");
     }
 }
 
-int main(int argc, char **argv)
+/*
+ * Run spec: which tests to run, on which buffer sizes, how often and how
+ * to print the results. Filled from the command line on a host/qemu build,
+ * or from looptest.cfg on the Dreamcast where there is no command line.
+ */
+enum {
+    FORMAT_DEFAULT, // report when all tests are selected, table otherwise
+    FORMAT_REPORT,  // full summary + recommendations (needs all tests)
+    FORMAT_TABLE,   // raw performance table only
+    FORMAT_CSV      // one machine-readable line per test and size
+};
+
+typedef struct {
+    unsigned char selected[NUM_TESTS];
+    unsigned int num_selected;
+    unsigned int sizes[MAX_SIZES];
+    unsigned int num_sizes;
+    unsigned int num_runs;
+    int format;
+} RunSpec;
+
+// Searched in order when no arguments are given; first file found wins.
+// /pc/ is the dcload host directory, so the spec can be edited without
+// rebuilding the romdisk.
+static const char* config_paths[] = {
+#ifdef _arch_dreamcast
+    "/pc/looptest.cfg",
+    "/rd/looptest.cfg",
+#else
+    "looptest.cfg",
+#endif
+};
+
+static void print_usage(const char *prog)
 {
-    (void)argc;  // Suppress unused parameter warning
-    (void)argv;  // Suppress unused parameter warning
+    printf("Usage: %s [options]\n\n", prog);
+    printf("  -t, --tests LIST   tests to run: indices, ranges or name patterns,\n");
+    printf("                     comma separated, e.g. 0,4-7,\"32-bit*\",*prefetch*\n");
+    printf("  -s, --size LIST    buffer sizes in pixels (k/m suffix allowed),\n");
+    printf("                     multiple of %u, max %u, e.g. 4k,64k,512k\n",
+           SIZE_ALIGN, MAX_PIXELS);
+    printf("                     -t and -s may be repeated, lists add up\n");
+    printf("  -r, --runs N       iterations per test (best time is reported)\n");
+    printf("  -f, --format FMT   report, table or csv (default: report when all\n");
+    printf("                     tests are selected, table otherwise)\n");
+    printf("  -l, --list         list available tests and exit\n");
+    printf("  -h, --help         show this help and exit\n\n");
+    printf("Without arguments the same options are read from");
+    for (unsigned int i = 0; i < sizeof(config_paths) / sizeof(config_paths[0]); i++)
+        printf(" %s", config_paths[i]);
+    printf(",\nwhitespace separated, '#' starts a comment.\n");
+}
     
-    uint64_t times[17];
-    unsigned int test, run;
-    const unsigned int num_runs = 5;
+static void list_tests(void)
+{
+    for (unsigned int test = 0; test < NUM_TESTS; test++)
+        printf("Test %2u: %s\n", test, test_names[test]);
+}
     
-    printf("BGR555 to RGB565 Conversion Benchmark for Dreamcast SH4\n");
-    printf("========================================================\n");
-    printf("Buffer size: %u pixels (%u KB)\n", 0x80000, (0x80000 * 2) / 1024);
-    printf("Running %u iterations per test\n\n", num_runs);
+// Case-insensitive glob match supporting '*' and '?'
+static int match_pattern(const char *pat, const char *str)
+{
+    if (*pat == '\0')
+        return *str == '\0';
+    if (*pat == '*') {
+        for (;;) {
+            if (match_pattern(pat + 1, str))
+                return 1;
+            if (*str == '\0')
+                return 0;
+            str++;
+        }
+    }
+    if (*str == '\0')
+        return 0;
+    if (*pat != '?' && tolower((unsigned char)*pat) != tolower((unsigned char)*str))
+        return 0;
+    return match_pattern(pat + 1, str + 1);
+}
     
-    // Warm up and verify
-    warmup_and_verify();
+// Parse a count with an optional k/m suffix (x1024, x1024*1024)
+static int parse_count(const char *s, unsigned int *out)
+{
+    char *end;
+    unsigned long val;
+    unsigned long mult = 1;
     
-    printf("Running tests...\n");
-    printf("----------------\n\n");
+    if (!isdigit((unsigned char)*s))
+        return -1;
+    errno = 0;
+    val = strtoul(s, &end, 10);
+    if (errno == ERANGE)
+        return -1;
+    if (*end == 'k' || *end == 'K') {
+        mult = 1024;
+        end++;
+    } else if (*end == 'm' || *end == 'M') {
+        mult = 1024 * 1024;
+        end++;
+    }
+    if (*end != '\0' || val > UINT_MAX / mult)
+        return -1;
+    *out = (unsigned int)(val * mult);
+    return 0;
+}
     
-    // Run all tests
-    for (test = 0; test < 17; test++) {
-        uint64_t total_time = 0;
-        uint64_t min_time = UINT64_MAX;
+static int select_tests(RunSpec *spec, const char *list)
+{
+    char item[64];
         
-        // Multiple runs to get average and minimum
-        for (run = 0; run < num_runs; run++) {
-            uint64_t before = read_counter_us();
-            convert_buffer(buffer_bgr555, buffer_rgb565, 0x80000, test);
-            uint64_t after = read_counter_us();
+    while (*list) {
+        size_t len = strcspn(list, ",");
+        if (len == 0 || len >= sizeof(item)) {
+            fprintf(stderr, "Bad test selector in '%s'\n", list);
+            return -1;
+        }
+        memcpy(item, list, len);
+        item[len] = '\0';
+        list += len;
+        if (*list == ',')
+            list++;
             
-            uint64_t elapsed = after - before;
-            total_time += elapsed;
-            if (elapsed < min_time) {
-                min_time = elapsed;
+        // Index or index range
+        char *end;
+        unsigned int matched = 0;
+        if (isdigit((unsigned char)item[0])) {
+            unsigned long first = strtoul(item, &end, 10);
+            unsigned long last = first;
+            if (*end == '-' && isdigit((unsigned char)end[1]))
+                last = strtoul(end + 1, &end, 10);
+            if (*end == '\0') {
+                if (first > last || last >= NUM_TESTS) {
+                    fprintf(stderr, "Test range '%s' out of bounds (0-%u)\n",
+                            item, NUM_TESTS - 1);
+                    return -1;
+                }
+                for (unsigned long test = first; test <= last; test++) {
+                    spec->selected[test] = 1;
+                    matched++;
+                }
+                continue;
             }
         }
         
-        times[test] = min_time;
+        // Otherwise a name pattern, "all" being shorthand for "*"
+        const char *pat = strcmp(item, "all") == 0 ? "*" : item;
+        for (unsigned int test = 0; test < NUM_TESTS; test++) {
+            if (match_pattern(pat, test_names[test])) {
+                spec->selected[test] = 1;
+                matched++;
+            }
+        }
+        if (!matched) {
+            fprintf(stderr, "No test matches '%s' (try --list)\n", item);
+            return -1;
+        }
+    }
+    return 0;
+}
         
-        // Simple progress indicator
-        printf("Test %2d: %-24s completed\n", test, test_names[test]);
+static int select_sizes(RunSpec *spec, const char *list)
+{
+    char item[32];
+
+    while (*list) {
+        size_t len = strcspn(list, ",");
+        unsigned int size;
+        if (len == 0 || len >= sizeof(item)) {
+            fprintf(stderr, "Bad size in '%s'\n", list);
+            return -1;
+        }
+        memcpy(item, list, len);
+        item[len] = '\0';
+        list += len;
+        if (*list == ',')
+            list++;
+
+        if (parse_count(item, &size) < 0 || size == 0 || size > MAX_PIXELS
+            || size % SIZE_ALIGN != 0) {
+            fprintf(stderr, "Bad size '%s': need a multiple of %u up to %u pixels\n",
+                    item, SIZE_ALIGN, MAX_PIXELS);
+            return -1;
+        }
+        if (spec->num_sizes == MAX_SIZES) {
+            fprintf(stderr, "Too many sizes (max %u)\n", MAX_SIZES);
+            return -1;
+        }
+        spec->sizes[spec->num_sizes++] = size;
+    }
+    return 0;
+}
+
+// Returns 0 to run, 1 to exit successfully (help/list), -1 on error.
+// cfg is the config file the arguments came from, NULL for the command line.
+static int parse_args(RunSpec *spec, int argc, char **argv, const char *cfg)
+{
+    int have_tests = 0;
+    int have_sizes = 0;
+
+    for (int i = 1; i < argc; i++) {
+        const char *opt = argv[i];
+
+        if (!strcmp(opt, "-h") || !strcmp(opt, "--help")) {
+            print_usage(argv[0]);
+            return 1;
+        }
+        if (!strcmp(opt, "-l") || !strcmp(opt, "--list")) {
+            list_tests();
+            return 1;
+        }
+
+        if (i + 1 >= argc) {
+            fprintf(stderr, "Unknown option or missing value: '%s'\n", opt);
+            if (!cfg)
+                print_usage(argv[0]);
+            return -1;
+        }
+        const char *val = argv[++i];
+
+        if (!strcmp(opt, "-t") || !strcmp(opt, "--tests")) {
+            if (!have_tests) {
+                memset(spec->selected, 0, sizeof(spec->selected));
+                have_tests = 1;
+            }
+            if (select_tests(spec, val) < 0)
+                return -1;
+        } else if (!strcmp(opt, "-s") || !strcmp(opt, "--size")) {
+            if (!have_sizes) {
+                spec->num_sizes = 0;
+                have_sizes = 1;
+            }
+            if (select_sizes(spec, val) < 0)
+                return -1;
+        } else if (!strcmp(opt, "-r") || !strcmp(opt, "--runs")) {
+            if (parse_count(val, &spec->num_runs) < 0 || spec->num_runs == 0) {
+                fprintf(stderr, "Bad run count '%s'\n", val);
+                return -1;
+            }
+        } else if (!strcmp(opt, "-f") || !strcmp(opt, "--format")) {
+            if (!strcmp(val, "report"))
+                spec->format = FORMAT_REPORT;
+            else if (!strcmp(val, "table"))
+                spec->format = FORMAT_TABLE;
+            else if (!strcmp(val, "csv"))
+                spec->format = FORMAT_CSV;
+            else {
+                fprintf(stderr, "Unknown format '%s'\n", val);
+                return -1;
+            }
+        } else {
+            fprintf(stderr, "Unknown option '%s'\n", opt);
+            if (!cfg)
+                print_usage(argv[0]);
+            return -1;
+        }
+    }
+
+    spec->num_selected = 0;
+    for (unsigned int test = 0; test < NUM_TESTS; test++)
+        spec->num_selected += spec->selected[test];
+    if (spec->num_selected == 0) {
+        fprintf(stderr, "No tests selected\n");
+        return -1;
+    }
+    if (spec->num_sizes == 0) {
+        fprintf(stderr, "No buffer sizes given\n");
+        return -1;
+    }
+    if (spec->format == FORMAT_REPORT && spec->num_selected < NUM_TESTS) {
+        fprintf(stderr, "The report format compares all %u tests; "
+                "use -f table or csv for a subset\n", NUM_TESTS);
+        return -1;
+    }
+    return 0;
+}
+
+// Split a config file into argv-style tokens and hand them to parse_args.
+// Tokens are whitespace separated, "double quotes" keep spaces, '#' comments.
+// Files over 4 KB are rejected rather than cut off mid-token.
+static int load_config(RunSpec *spec)
+{
+    static char text[4096];
+    char *tokens[128];
+    int count = 0;
+    const char *path = NULL;
+    FILE *f = NULL;
+
+    for (unsigned int i = 0; i < sizeof(config_paths) / sizeof(config_paths[0]); i++) {
+        f = fopen(config_paths[i], "r");
+        if (f) {
+            path = config_paths[i];
+            break;
+        }
+    }
+    if (!f)
+        return parse_args(spec, 0, NULL, NULL);
+
+    size_t len = fread(text, 1, sizeof(text) - 1, f);
+    int too_large = len == sizeof(text) - 1 && fgetc(f) != EOF;
+    fclose(f);
+    if (too_large) {
+        fprintf(stderr, "%s: config too large (max %u bytes)\n",
+                path, (unsigned int)sizeof(text) - 1);
+        return -1;
+    }
+    text[len] = '\0';
+    tokens[count++] = "looptest";
+
+    char *p = text;
+    while (*p) {
+        if (isspace((unsigned char)*p)) {
+            p++;
+        } else if (*p == '#') {
+            while (*p && *p != '\n')
+                p++;
+        } else {
+            if (count == (int)(sizeof(tokens) / sizeof(tokens[0]))) {
+                fprintf(stderr, "%s: too many options\n", path);
+                return -1;
+            }
+            // Strip quotes in place, shell style: "32-bit*",14 -> 32-bit*,14
+            char *out = p;
+            int quoted = 0;
+            tokens[count++] = out;
+            while (*p && (quoted || !isspace((unsigned char)*p))) {
+                if (*p == '"')
+                    quoted = !quoted;
+                else
+                    *out++ = *p;
+                p++;
+            }
+            if (*p)
+                p++;
+            *out = '\0';
+        }
+    }
+
+    int status = parse_args(spec, count, tokens, path);
+    if (status < 0)
+        fprintf(stderr, "%s: bad run spec\n", path);
+    return status;
+}
+
+static uint64_t time_batch(unsigned int size, unsigned int test, unsigned int batch)
+{
+    uint64_t before = read_counter_us();
+    for (unsigned int i = 0; i < batch; i++)
+        convert_buffer(buffer_bgr555, buffer_rgb565, size, test);
+    return read_counter_us() - before;
+}
+
+// Smallest power-of-two batch whose sample lasts at least MIN_SAMPLE_US;
+// 1 for the full-size buffer on the Dreamcast
+static unsigned int calibrate_batch(unsigned int size, unsigned int test)
+{
+    unsigned int batch = 1;
+    while (batch < MAX_BATCH && time_batch(size, test, batch) < MIN_SAMPLE_US)
+        batch *= 2;
+    return batch;
+}
+
+static double mb_per_sec(unsigned int size, double time)
+{
+    return ((double)size * 2.0 * 1000000.0) / (time * 1024.0 * 1024.0);
+}
+
+static unsigned int find_best(const RunSpec *spec, const double *times)
+{
+    unsigned int best_test = NUM_TESTS;
+    for (unsigned int test = 0; test < NUM_TESTS; test++) {
+        if (spec->selected[test] &&
+            (best_test == NUM_TESTS || times[test] < times[best_test]))
+            best_test = test;
     }
+    return best_test;
+}
+
+// Summary and recommendations; only meaningful when every test was run
+static void print_report(const double *times, unsigned int size)
+{
+    unsigned int test;
     
     // Find best result
-    uint64_t best_time = times[0];
+    double best_time = times[0];
     unsigned int best_test = 0;
-    for (test = 1; test < 17; test++) {
+    for (test = 1; test < NUM_TESTS; test++) {
         if (times[test] < best_time) {
             best_time = times[test];
             best_test = test;
@@ -493,12 +853,12 @@ int main(int argc, char **argv)
     }
     
     // Calculate performance metrics
-    double best_mb_per_sec = ((double)0x80000 * 2.0 * 1000000.0) / (best_time * 1024.0 * 1024.0);
+    double best_mb_per_sec = mb_per_sec(size, best_time);
     
     printf("\n========== RESULTS SUMMARY ==========\n\n");
     
     printf("*** WINNER: Test %d (%s) ***\n", best_test, test_names[best_test]);
-    printf("    Time: %llu microseconds\n", best_time);
+    printf("    Time: %.2f microseconds\n", best_time);
     printf("    Speed: %.1f MB/s\n\n", best_mb_per_sec);
     
     // Categorize and explain results
@@ -512,8 +872,8 @@ int main(int argc, char **argv)
         const char* category;
     } TestResult;
     
-    TestResult results[17];
-    for (test = 0; test < 17; test++) {
+    TestResult results[NUM_TESTS];
+    for (test = 0; test < NUM_TESTS; test++) {
         results[test].test_id = test;
         results[test].relative_perf = (double)times[test] / best_time;
         
@@ -553,7 +913,7 @@ int main(int argc, char **argv)
     }
     
     printf("\nADVANCED TECHNIQUES:\n");
-    for (test = 14; test < 17; test++) {
+    for (test = 14; test < NUM_TESTS; test++) {
         printf("  %s  Test %2d: %-24s  %5.2fx slower\n",
                results[test].category, test, test_names[test], results[test].relative_perf);
     }
@@ -641,15 +1001,127 @@ int main(int argc, char **argv)
            (double)times[0] / best_time);
     
     printf("\n============================================\n");
+}
+
+static void print_table(const RunSpec *spec, const double *times, unsigned int size)
+{
+    double best_time = times[find_best(spec, times)];
     
     printf("\n\n--- RAW PERFORMANCE DATA ---\n");
     printf("----------------------------\n");
-    for (test = 0; test < 17; test++) {
-        double mb_per_sec = ((double)0x80000 * 2.0 * 1000000.0) / (times[test] * 1024.0 * 1024.0);
-        printf("Test %2d: %6llu us  %6.1f MB/s  %5.2fx\n", 
-               test, times[test], mb_per_sec, (double)times[test] / best_time);
+    for (unsigned int test = 0; test < NUM_TESTS; test++) {
+        if (!spec->selected[test])
+            continue;
+        printf("Test %2d: %9.2f us  %6.1f MB/s  %5.2fx  %s\n",
+               test, times[test], mb_per_sec(size, times[test]),
+               (double)times[test] / best_time, test_names[test]);
     }
     printf("\n");
+}
+
+static void print_csv(const RunSpec *spec, const double *times,
+                      const double *avg_times, const unsigned int *batches,
+                      unsigned int size)
+{
+    double best_time = times[find_best(spec, times)];
+
+    for (unsigned int test = 0; test < NUM_TESTS; test++) {
+        if (!spec->selected[test])
+            continue;
+        printf("%u,%u,\"%s\",%u,%u,%.3f,%.3f,%.1f,%.2f\n",
+               size, test, test_names[test], spec->num_runs, batches[test],
+               times[test], avg_times[test],
+               mb_per_sec(size, times[test]), (double)times[test] / best_time);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    RunSpec spec;
+    double times[NUM_TESTS];
+    double avg_times[NUM_TESTS];
+    unsigned int batches[NUM_TESTS];
+    unsigned int test, run, s;
+    int status;
+
+    // Defaults: every test, full 1 MB buffer, 5 runs, full report
+    memset(&spec, 0, sizeof(spec));
+    memset(spec.selected, 1, sizeof(spec.selected));
+    spec.sizes[0] = MAX_PIXELS;
+    spec.num_sizes = 1;
+    spec.num_runs = 5;
+    spec.format = FORMAT_DEFAULT;
+
+    status = argc > 1 ? parse_args(&spec, argc, argv, NULL) : load_config(&spec);
+    if (status != 0)
+        return status < 0 ? 1 : 0;
+
+    int csv = spec.format == FORMAT_CSV;
+
+    if (csv) {
+        printf("size_pixels,test,name,runs,batch,min_us,avg_us,mb_per_sec,relative\n");
+    } else {
+        printf("BGR555 to RGB565 Conversion Benchmark for Dreamcast SH4\n");
+        printf("========================================================\n");
+        if (spec.num_selected < NUM_TESTS)
+            printf("Running %u of %u tests\n", spec.num_selected, NUM_TESTS);
+        printf("Running %u iterations per test\n\n", spec.num_runs);
+    }
+
+    // Warm up and verify
+    warmup_and_verify(csv);
+
+    for (s = 0; s < spec.num_sizes; s++) {
+        unsigned int size = spec.sizes[s];
+
+        if (!csv) {
+            printf("Buffer size: %u pixels (%u KB)\n", size, (size * 2) / 1024);
+            printf("Running tests...\n");
+            printf("----------------\n\n");
+        }
+
+        // Run selected tests
+        for (test = 0; test < NUM_TESTS; test++) {
+            if (!spec.selected[test])
+                continue;
+
+            uint64_t total_time = 0;
+            uint64_t min_time = UINT64_MAX;
+            unsigned int batch = calibrate_batch(size, test);
+
+            // Multiple runs to get average and minimum
+            for (run = 0; run < spec.num_runs; run++) {
+                uint64_t elapsed = time_batch(size, test, batch);
+                total_time += elapsed;
+                if (elapsed < min_time) {
+                    min_time = elapsed;
+                }
+            }
+
+            // Report per-conversion times
+            times[test] = (double)min_time / batch;
+            avg_times[test] = (double)total_time / spec.num_runs / batch;
+            batches[test] = batch;
+
+            // Simple progress indicator
+            if (!csv) {
+                if (batch > 1)
+                    printf("Test %2d: %-24s completed (%u per sample)\n",
+                           test, test_names[test], batch);
+                else
+                    printf("Test %2d: %-24s completed\n", test, test_names[test]);
+            }
+        }
+
+        if (csv) {
+            print_csv(&spec, times, avg_times, batches, size);
+        } else {
+            if (spec.format == FORMAT_REPORT ||
+                (spec.format == FORMAT_DEFAULT && spec.num_selected == NUM_TESTS))
+                print_report(times, size);
+            print_table(&spec, times, size);
+        }
+    }
     
     return 0;
 }
\ No newline at end of file